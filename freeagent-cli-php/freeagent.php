@@ -17,6 +17,7 @@ $application->add(new App\Command\GetRunningTimers($config));
 $application->add(new App\Command\GetTaskList($config));
 $application->add(new App\Command\GetTimeslipList($config));
 $application->add(new App\Command\Login($config));
+$application->add(new App\Command\MockServer());
 $application->add(new App\Command\StartTimer($config));
 $application->add(new App\Command\StopTimer($config));
 $returnCode = $application->run();
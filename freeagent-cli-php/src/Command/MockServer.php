@@ -0,0 +1,48 @@
+<?php
+
+namespace App\Command;
+
+use App\MockApi;
+use Symfony\Component\Console\Command\Command;
+use Symfony\Component\Console\Input\InputInterface;
+use Symfony\Component\Console\Input\InputOption;
+use Symfony\Component\Console\Output\OutputInterface;
+
+class MockServer extends Command
+{
+    protected static $defaultName = 'mock-server';
+
+    protected function configure()
+    {
+        $this
+            ->setDescription('Serve a local stand-in for the FreeAgent API (use environment "mock")')
+            ->addOption('host', null, InputOption::VALUE_REQUIRED, 'Address to listen on', '127.0.0.1')
+            ->addOption('port', null, InputOption::VALUE_REQUIRED, 'Port to listen on, or 0 for any free port', 12424)
+            ->addOption('latency', null, InputOption::VALUE_REQUIRED, 'Milliseconds to delay every response by', 0)
+            ->addOption('jitter', null, InputOption::VALUE_REQUIRED, 'Up to this many extra milliseconds of random delay', 0)
+            ->addOption('per-page', null, InputOption::VALUE_REQUIRED, 'Default page size for collections', 25)
+            ->addOption('error-rate', null, InputOption::VALUE_REQUIRED, 'Fraction of requests (0-1) to fail with a 503', 0)
+            ->addOption('budget', null, InputOption::VALUE_REQUIRED, 'Requests allowed per command run before answering 429 (0 for no limit)', 0)
+            ->addOption('extra-timeslips', null, InputOption::VALUE_REQUIRED, 'Extra timeslips to seed for today', 0);
+    }
+
+    protected function execute(InputInterface $input, OutputInterface $output)
+    {
+        $loop = \React\EventLoop\Factory::create();
+
+        $api = new MockApi($loop, $output, [
+            'host' => $input->getOption('host'),
+            'port' => (int) $input->getOption('port'),
+            'latency' => (int) $input->getOption('latency'),
+            'jitter' => (int) $input->getOption('jitter'),
+            'perPage' => (int) $input->getOption('per-page'),
+            'errorRate' => (float) $input->getOption('error-rate'),
+            'budget' => (int) $input->getOption('budget'),
+            'extraTimeslips' => (int) $input->getOption('extra-timeslips'),
+        ]);
+        $api->listen();
+
+        $loop->run();
+        return Command::SUCCESS;
+    }
+}
\ No newline at end of file
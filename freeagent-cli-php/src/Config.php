@@ -9,6 +9,7 @@ class Config
     public $clientSecret = "";
     public $accessToken;
     public $timeslipUser;
+    public $mockUrl = "http://127.0.0.1:12424/v2/";
 
     public function load($filename)
     {
@@ -19,6 +20,7 @@ class Config
         @$this->clientSecret = $data['clientSecret'];
         @$this->accessToken = $data['accessToken'];
         @$this->timeslipUser = $data['timeslipUser'];
+        @$this->mockUrl = $data['mockUrl'] ?? $this->mockUrl;
     }
 
     public function save($filename)
@@ -32,6 +34,7 @@ class Config
             "clientSecret" => $this->clientSecret,
             "accessToken" => $this->accessToken,
             "timeslipUser" => $this->timeslipUser,
+            "mockUrl" => $this->mockUrl,
         ];
         file_put_contents($filename, json_encode($array));
     }
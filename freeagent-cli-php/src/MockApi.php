@@ -0,0 +1,411 @@
+<?php
+
+namespace App;
+
+use Psr\Http\Message\ServerRequestInterface;
+use React\Http\Message\Response;
+use Symfony\Component\Console\Output\OutputInterface;
+
+/**
+ * A local stand-in for the parts of the FreeAgent API this tool talks to. It
+ * keeps a small set of projects, tasks and timeslips in memory and can add
+ * latency, errors and a per-command request budget to every response, so that
+ * commands can be exercised and timed without touching the sandbox.
+ */
+class MockApi
+{
+    /**
+     * Requests carrying the same value in this header belong to one command,
+     * and share one request budget.
+     */
+    const RUN_HEADER = 'X-Mock-Run';
+
+    protected $loop;
+    protected $output;
+    protected $options;
+    protected $baseUrl;
+
+    protected $projects = [];
+    protected $tasks = [];
+    protected $timeslips = [];
+    protected $nextTimeslipId = 1;
+
+    /**
+     * Request counts keyed by run, since the server started or was last reset
+     */
+    protected $runs = [];
+
+    public function __construct($loop, OutputInterface $output, array $options = [])
+    {
+        $this->loop = $loop;
+        $this->output = $output;
+        $this->options = $options + [
+            'host' => '127.0.0.1',
+            'port' => 12424,
+            'latency' => 0,
+            'jitter' => 0,
+            'perPage' => 25,
+            'errorRate' => 0,
+            'budget' => 0,
+            'extraTimeslips' => 0,
+        ];
+    }
+
+    public function listen()
+    {
+        $server = new \React\Http\Server($this->loop, function (ServerRequestInterface $request) {
+            return $this->handle($request);
+        });
+
+        $socket = new \React\Socket\Server(
+            $this->options['host'] . ':' . $this->options['port'],
+            $this->loop
+        );
+        $server->listen($socket);
+
+        // Port 0 asks for any free port, so build URLs from what we really got
+        $this->baseUrl = str_replace('tcp://', 'http://', $socket->getAddress()) . '/v2/';
+        $this->seed();
+
+        $this->output->writeln(sprintf('Mock API listening on %s', $this->baseUrl));
+    }
+
+    protected function handle(ServerRequestInterface $request)
+    {
+        $path = trim(preg_replace('#^/v2#', '', $request->getUri()->getPath()), '/');
+        if ($request->getMethod() == 'POST' && $path == '__mock/reset') {
+            return $this->reset();
+        }
+
+        $run = $request->getHeaderLine(self::RUN_HEADER) ?: '-';
+        $this->runs[$run] = ($this->runs[$run] ?? 0) + 1;
+        $requestNumber = $this->runs[$run];
+
+        $response = $this->injectFault($run) ?? $this->route($request, $path);
+
+        $delay = $this->options['latency'];
+        if ($this->options['jitter'] > 0) {
+            $delay += mt_rand(0, $this->options['jitter']);
+        }
+
+        return new \React\Promise\Promise(function ($resolve) use ($request, $response, $run, $requestNumber, $delay) {
+            $this->loop->addTimer($delay / 1000, function () use ($resolve, $request, $response, $run, $requestNumber, $delay) {
+                $this->output->writeln(sprintf(
+                    '[%s] #%d %s %s -> %d (%d ms)',
+                    $run,
+                    $requestNumber,
+                    $request->getMethod(),
+                    $request->getRequestTarget(),
+                    $response->getStatusCode(),
+                    $delay
+                ));
+                $resolve($response);
+            });
+        });
+    }
+
+    /**
+     * Report how many requests each run has made since the last reset, then
+     * start counting from zero. Control requests are never counted, delayed
+     * or failed.
+     */
+    protected function reset()
+    {
+        $runs = $this->runs;
+        $this->runs = [];
+        $this->output->writeln(sprintf(
+            '-- reset after %d request(s) from %d run(s)',
+            array_sum($runs),
+            count($runs)
+        ));
+        return $this->json(200, [
+            'requests' => array_sum($runs),
+            'runs' => (object) $runs,
+        ]);
+    }
+
+    /**
+     * Returns an error response if the run has spent its budget or the dice
+     * say so, otherwise null.
+     */
+    protected function injectFault($run)
+    {
+        if ($this->options['budget'] > 0 && $this->runs[$run] > $this->options['budget']) {
+            return $this->error(429, sprintf(
+                'Request budget of %d exceeded',
+                $this->options['budget']
+            ), ['Retry-After' => '1']);
+        }
+        if ($this->options['errorRate'] > 0 && mt_rand() / mt_getrandmax() < $this->options['errorRate']) {
+            return $this->error(503, 'Injected failure');
+        }
+        return null;
+    }
+
+    protected function route(ServerRequestInterface $request, $path)
+    {
+        $method = $request->getMethod();
+        $query = $request->getQueryParams();
+
+        // OAuth endpoints don't need a bearer token
+        if ($method == 'GET' && $path == 'approve_app') {
+            $location = ($query['redirect_uri'] ?? '') . '?' . http_build_query([
+                'code' => 'mock-code',
+                'state' => $query['state'] ?? '',
+            ]);
+            return new Response(302, ['Location' => $location]);
+        }
+        if ($method == 'POST' && $path == 'token_endpoint') {
+            return $this->json(200, [
+                'access_token' => 'mock-access-token',
+                'token_type' => 'bearer',
+                'expires_in' => 604800,
+                'refresh_token' => 'mock-refresh-token',
+            ]);
+        }
+
+        if (strpos($request->getHeaderLine('Authorization'), 'Bearer ') !== 0) {
+            return $this->error(401, 'Access token not recognised');
+        }
+
+        if ($method == 'GET' && $path == 'company') {
+            return $this->json(200, ['company' => [
+                'url' => $this->baseUrl . 'company',
+                'name' => 'Mock Company',
+                'subdomain' => 'mock',
+            ]]);
+        }
+        if ($method == 'GET' && $path == 'projects') {
+            return $this->paginate($request, 'projects', array_values($this->projects));
+        }
+        if ($method == 'GET' && preg_match('#^projects/(\d+)$#', $path, $m)) {
+            return $this->show('project', $this->projects, $m[1]);
+        }
+        if ($method == 'GET' && $path == 'tasks') {
+            return $this->paginate($request, 'tasks', array_values($this->tasks));
+        }
+        if ($method == 'GET' && preg_match('#^tasks/(\d+)$#', $path, $m)) {
+            return $this->show('task', $this->tasks, $m[1]);
+        }
+        if ($method == 'GET' && $path == 'timeslips') {
+            return $this->paginate($request, 'timeslips', $this->filterTimeslips($query));
+        }
+        if ($method == 'GET' && preg_match('#^timeslips/(\d+)$#', $path, $m)) {
+            return $this->show('timeslip', $this->timeslips, $m[1]);
+        }
+        if ($method == 'POST' && $path == 'timeslips') {
+            return $this->createTimeslip($request);
+        }
+        if (preg_match('#^timeslips/(\d+)/timer$#', $path, $m) && isset($this->timeslips[$m[1]])) {
+            if ($method == 'POST') {
+                return $this->startTimer($m[1]);
+            }
+            if ($method == 'DELETE') {
+                return $this->stopTimer($m[1]);
+            }
+        }
+
+        return $this->error(404, 'Resource not found');
+    }
+
+    protected function filterTimeslips(array $query)
+    {
+        $timeslips = [];
+        foreach ($this->timeslips as $timeslip) {
+            if (($query['view'] ?? '') == 'running' && !isset($timeslip['timer'])) {
+                continue;
+            }
+            if (isset($query['from_date']) && $timeslip['dated_on'] < $query['from_date']) {
+                continue;
+            }
+            if (isset($query['to_date']) && $timeslip['dated_on'] > $query['to_date']) {
+                continue;
+            }
+            // Accept either a task URL or a bare ID
+            if (isset($query['task']) && basename($timeslip['task']) != basename($query['task'])) {
+                continue;
+            }
+            $timeslips[] = $timeslip;
+        }
+        return $timeslips;
+    }
+
+    protected function createTimeslip(ServerRequestInterface $request)
+    {
+        $data = json_decode((string) $request->getBody(), true);
+        if (!isset($data['timeslip']['task'], $data['timeslip']['project'], $data['timeslip']['dated_on'])) {
+            return $this->error(422, 'Timeslip requires task, project and dated_on');
+        }
+
+        $id = $this->nextTimeslipId++;
+        $this->timeslips[$id] = [
+            'url' => $this->baseUrl . 'timeslips/' . $id,
+            'user' => $data['timeslip']['user'] ?? $this->baseUrl . 'users/1',
+            'project' => $data['timeslip']['project'],
+            'task' => $data['timeslip']['task'],
+            'dated_on' => $data['timeslip']['dated_on'],
+            'hours' => (string) ($data['timeslip']['hours'] ?? 0),
+            'comment' => $data['timeslip']['comment'] ?? '',
+        ];
+        return $this->json(201, ['timeslip' => $this->timeslips[$id]]);
+    }
+
+    protected function startTimer($id)
+    {
+        if (!isset($this->timeslips[$id]['timer'])) {
+            $this->timeslips[$id]['timer'] = [
+                'running' => true,
+                'start_from' => date(DATE_ATOM),
+            ];
+        }
+        return $this->json(200, ['timeslip' => $this->timeslips[$id]]);
+    }
+
+    protected function stopTimer($id)
+    {
+        if (isset($this->timeslips[$id]['timer'])) {
+            $elapsed = time() - strtotime($this->timeslips[$id]['timer']['start_from']);
+            $this->timeslips[$id]['hours'] = (string) round($this->timeslips[$id]['hours'] + $elapsed / 3600, 2);
+            unset($this->timeslips[$id]['timer']);
+        }
+        return $this->json(200, ['timeslip' => $this->timeslips[$id]]);
+    }
+
+    protected function show($key, array $collection, $id)
+    {
+        if (!isset($collection[$id])) {
+            return $this->error(404, 'Resource not found');
+        }
+        return $this->json(200, [$key => $collection[$id]]);
+    }
+
+    /**
+     * Slice a collection the way FreeAgent does, honouring page and per_page
+     * and advertising the other pages in a Link header.
+     */
+    protected function paginate(ServerRequestInterface $request, $key, array $items)
+    {
+        $query = $request->getQueryParams();
+        $perPage = min(100, max(1, (int) ($query['per_page'] ?? $this->options['perPage'])));
+        $lastPage = max(1, (int) ceil(count($items) / $perPage));
+        $page = min($lastPage, max(1, (int) ($query['page'] ?? 1)));
+
+        $links = [];
+        $pageUrl = function ($page) use ($request, $query, $perPage) {
+            $uri = $request->getUri()->withQuery(http_build_query(
+                ['page' => $page, 'per_page' => $perPage] + $query
+            ));
+            return (string) $uri;
+        };
+        if ($page > 1) {
+            $links[] = sprintf('<%s>; rel="prev"', $pageUrl($page - 1));
+            $links[] = sprintf('<%s>; rel="first"', $pageUrl(1));
+        }
+        if ($page < $lastPage) {
+            $links[] = sprintf('<%s>; rel="next"', $pageUrl($page + 1));
+            $links[] = sprintf('<%s>; rel="last"', $pageUrl($lastPage));
+        }
+
+        $headers = ['X-Total-Count' => (string) count($items)];
+        if ($links) {
+            $headers['Link'] = implode(', ', $links);
+        }
+
+        return $this->json(200, [$key => array_slice($items, ($page - 1) * $perPage, $perPage)], $headers);
+    }
+
+    protected function json($status, array $data, array $headers = [])
+    {
+        return new Response(
+            $status,
+            ['Content-Type' => 'application/json'] + $headers,
+            json_encode($data)
+        );
+    }
+
+    /**
+     * FreeAgent's own error body, plus the top level error key the OAuth
+     * endpoints use, so the provider's checkResponse rejects it and commands
+     * fail instead of reading on into an empty response.
+     */
+    protected function error($status, $message, array $headers = [])
+    {
+        return $this->json($status, [
+            'error' => $message,
+            'errors' => ['error' => ['message' => $message]],
+        ], $headers);
+    }
+
+    /**
+     * Two clients, one billed by the hour and one by the day, with five
+     * timeslips logged today (one with its timer running) and one yesterday.
+     * The extraTimeslips option pads today out further, spread across the
+     * active tasks with every third timer running, so tests can check that a
+     * command's requests don't grow with the data.
+     */
+    protected function seed()
+    {
+        $today = date('Y-m-d');
+
+        $projects = [
+            1 => ['Acme Ltd', 'Website rebuild', 8],
+            2 => ['Globex Corporation', 'Support contract', 7.5],
+        ];
+        foreach ($projects as $id => list($contact, $name, $hoursPerDay)) {
+            $this->projects[$id] = [
+                'url' => $this->baseUrl . 'projects/' . $id,
+                'contact_name' => $contact,
+                'name' => $name,
+                'status' => 'Active',
+                'hours_per_day' => (string) $hoursPerDay,
+            ];
+        }
+
+        $tasks = [
+            1 => [1, 'Development', '65.0', 'hour', 'Active'],
+            2 => [1, 'Design', '55.0', 'hour', 'Active'],
+            3 => [2, 'Consultancy', '450.0', 'day', 'Active'],
+            4 => [2, 'Migration', '400.0', 'day', 'Completed'],
+        ];
+        foreach ($tasks as $id => list($project, $name, $rate, $period, $status)) {
+            $this->tasks[$id] = [
+                'url' => $this->baseUrl . 'tasks/' . $id,
+                'project' => $this->baseUrl . 'projects/' . $project,
+                'name' => $name,
+                'billing_rate' => $rate,
+                'billing_period' => $period,
+                'status' => $status,
+            ];
+        }
+
+        $timeslips = [
+            [1, $today, '2.5', 'Fix checkout form validation', false],
+            [2, $today, '1.0', 'Homepage mockups', false],
+            [3, $today, '3.75', 'Quarterly infrastructure review', false],
+            [1, $today, '0', 'Code review', true],
+            [3, $today, '1.5', 'Incident follow-up', false],
+            [3, date('Y-m-d', strtotime('-1 day')), '4.0', 'On-call handover', false],
+        ];
+        for ($i = 0; $i < $this->options['extraTimeslips']; $i++) {
+            $timeslips[] = [$i % 3 + 1, $today, '0.5', sprintf('Extra timeslip %d', $i + 1), $i % 3 == 0];
+        }
+        foreach ($timeslips as list($task, $datedOn, $hours, $comment, $running)) {
+            $id = $this->nextTimeslipId++;
+            $this->timeslips[$id] = [
+                'url' => $this->baseUrl . 'timeslips/' . $id,
+                'user' => $this->baseUrl . 'users/1',
+                'project' => $this->tasks[$task]['project'],
+                'task' => $this->tasks[$task]['url'],
+                'dated_on' => $datedOn,
+                'hours' => $hours,
+                'comment' => $comment,
+            ];
+            if ($running) {
+                $this->timeslips[$id]['timer'] = [
+                    'running' => true,
+                    'start_from' => date(DATE_ATOM, strtotime('-20 minutes')),
+                ];
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -3,7 +3,10 @@
  * Freeagent provider for league/ouath2-client
  * You can pass bool sandbox in the options array to change base URL, then you
  * can make getAuthenticatedRequests calls with a relative URL and the base will
- * be prepended.
+ * be prepended. Passing baseUrl instead (picked up by the parent constructor,
+ * like any option named after a property) points it anywhere else, such as the
+ * server started by the mock-server command; mockRun is then sent with every
+ * request so that server can tell one command's requests from another's.
  */
 
 namespace App\OAuth\Provider;
@@ -36,6 +39,11 @@ class FreeAgent extends AbstractProvider
 
     protected $baseUrl = 'https://api.freeagent.com/v2/';
 
+    /**
+     * @var string|null
+     */
+    protected $mockRun;
+
     public function __construct(array $options = array())
     {
         parent::__construct($options);
@@ -64,6 +72,11 @@ class FreeAgent extends AbstractProvider
         return null;
     }
 
+    protected function getDefaultHeaders()
+    {
+        return $this->mockRun ? ['X-Mock-Run' => $this->mockRun] : [];
+    }
+
     // From GenericProvider
     protected function checkResponse(ResponseInterface $response, $data)
     {
@@ -17,9 +17,18 @@ class ProviderAuthenticator
      */
     protected $oauth2state;
 
+    protected $authCode;
+
+    /**
+     * Tags every request this authenticator's provider makes, so the mock
+     * API can count and budget requests per command
+     */
+    protected $mockRun;
+
     public function __construct(Config $config)
     {
         $this->config = $config;
+        $this->mockRun = uniqid('', true);
     }
 
     public function getProvider()
@@ -34,6 +43,10 @@ class ProviderAuthenticator
             'redirectUri'  => 'http://127.0.0.1:12423/',
             'sandbox'      => $this->config->environment == "sandbox"
         ];
+        if ($this->config->environment == "mock") {
+            $oauthProviderConfig['baseUrl'] = $this->config->mockUrl;
+            $oauthProviderConfig['mockRun'] = $this->mockRun;
+        }
 
         return new FreeAgentProvider($oauthProviderConfig);
     }
@@ -61,15 +74,24 @@ class ProviderAuthenticator
         $provider = $this->getProvider();
 
         $authorizationUrl = $provider->getAuthorizationUrl();
-        $output->writeln(sprintf('Go to %s in your browser.', $authorizationUrl));
         // Generate a random state string.
         $this->oauth2state = $provider->getState();
 
-        // This will cause $this->authCode to be set
-        // Freeagent doesn't provide an option to display the token in the
-        // browser, so we'll boot up a web server, and set the allowable
-        // redirects to 127.0.0.1 in the freeagent integration settings.
-        $this->waitForToken();
+        if ($this->config->environment == "mock") {
+            // The mock API approves straight away, so there's no need for a
+            // browser; take the code from its redirect ourselves.
+            if (!$this->approveMockApp($provider, $authorizationUrl, $output)) {
+                return false;
+            }
+        } else {
+            $output->writeln(sprintf('Go to %s in your browser.', $authorizationUrl));
+
+            // This will cause $this->authCode to be set
+            // Freeagent doesn't provide an option to display the token in the
+            // browser, so we'll boot up a web server, and set the allowable
+            // redirects to 127.0.0.1 in the freeagent integration settings.
+            $this->waitForToken();
+        }
 
         try {
             // Try to get an access token using the authorization code grant.
@@ -99,6 +121,39 @@ class ProviderAuthenticator
         return true;
     }
 
+    /**
+     * Request the approval page without following its redirect, and set the
+     * code from the redirect URL in the class. Returns false if the mock API
+     * refused or answered with the wrong state.
+     */
+    private function approveMockApp(FreeAgentProvider $provider, $authorizationUrl, OutputInterface $output)
+    {
+        // getRequest adds the provider's default headers, so this counts
+        // towards the login's own run on the mock API
+        $request = $provider->getRequest('GET', $authorizationUrl);
+        $response = $provider->getHttpClient()->send($request, [
+            'allow_redirects' => false,
+            'http_errors' => false
+        ]);
+        if ($response->getStatusCode() != 302) {
+            $output->writeln(sprintf(
+                'Approval failed: HTTP %d %s',
+                $response->getStatusCode(),
+                $response->getReasonPhrase()
+            ));
+            return false;
+        }
+
+        parse_str((string) parse_url($response->getHeaderLine('Location'), PHP_URL_QUERY), $queryParams);
+        if (!isset($queryParams['state'], $queryParams['code']) || $queryParams['state'] !== $this->oauth2state) {
+            $output->writeln('Approval failed: oauth2state did not match');
+            return false;
+        }
+        $this->authCode = $queryParams['code'];
+
+        return true;
+    }
+
     /**
      * Start an HTTP server and wait for a request with state and code to come
      * in. Set the code in the class and kill the HTTP server.
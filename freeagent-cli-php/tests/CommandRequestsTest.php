@@ -0,0 +1,303 @@
+<?php
+
+namespace App\Tests;
+
+use App\Command\CreateTimeslip;
+use App\Command\GetDailyTotal;
+use App\Command\GetRunningTimers;
+use App\Command\GetTaskList;
+use App\Command\GetTimeslipList;
+use App\Command\Login;
+use App\Command\StartTimer;
+use App\Command\StopTimer;
+use App\Config;
+use League\OAuth2\Client\Provider\Exception\IdentityProviderException;
+use PHPUnit\Framework\TestCase;
+use Symfony\Component\Console\Command\Command;
+use Symfony\Component\Console\Tester\CommandTester;
+
+/**
+ * Runs each command against a freshly started mock API and pins down how many
+ * requests it makes and how long it takes, so a command that starts fetching
+ * one thing per row fails here instead of just feeling slow.
+ */
+class CommandRequestsTest extends TestCase
+{
+    /**
+     * Milliseconds the mock API waits before every response
+     */
+    const LATENCY = 50;
+
+    /**
+     * Milliseconds a command may spend on top of its requests' latency, for
+     * PHP, Guzzle and a busy machine
+     */
+    const SLACK = 1000;
+
+    /**
+     * Extra timeslips to seed for the smaller of the two data sets that list
+     * commands are compared across; the larger one has twice as many
+     */
+    const EXTRA_TIMESLIPS = 3;
+
+    protected $server;
+    protected $log;
+    protected $baseUrl;
+
+    protected function tearDown(): void
+    {
+        $this->stopServer();
+    }
+
+    public function commandProvider()
+    {
+        return [
+            'get-daily-total' => [GetDailyTotal::class, []],
+            'get-task-list' => [GetTaskList::class, []],
+            'get-timeslip-list' => [GetTimeslipList::class, ['taskId' => '1']],
+            'get-running-timers' => [GetRunningTimers::class, []],
+            'create-timeslip' => [CreateTimeslip::class, ['taskId' => '1', 'comment' => 'Testing']],
+            'start-timer' => [StartTimer::class, ['timeslipId' => '2']],
+            'stop-timer' => [StopTimer::class, ['timeslipId' => '4']],
+        ];
+    }
+
+    /**
+     * Every request should cost the injected latency, and nothing else should
+     * cost much more than that
+     *
+     * @dataProvider commandProvider
+     */
+    public function testCommandTimeFollowsRequests($commandClass, array $arguments)
+    {
+        $this->startServer(['--latency' => self::LATENCY]);
+
+        $started = microtime(true);
+        $status = $this->runCommand(new $commandClass($this->mockConfig()), $arguments);
+        $elapsed = (microtime(true) - $started) * 1000;
+        $requests = $this->resetServer()['requests'];
+
+        $this->assertSame(Command::SUCCESS, $status);
+        $this->assertGreaterThan(0, $requests);
+        $this->assertGreaterThanOrEqual($requests * self::LATENCY, $elapsed);
+        $this->assertLessThan($requests * self::LATENCY + self::SLACK, $elapsed);
+    }
+
+    public function singleTimeslipCommandProvider()
+    {
+        return [
+            // The task, the new timeslip, then its timer
+            'create-timeslip' => [CreateTimeslip::class, ['taskId' => '1', 'comment' => 'Testing'], 3],
+            'start-timer' => [StartTimer::class, ['timeslipId' => '2'], 1],
+            'stop-timer' => [StopTimer::class, ['timeslipId' => '4'], 1],
+        ];
+    }
+
+    /**
+     * @dataProvider singleTimeslipCommandProvider
+     */
+    public function testSingleTimeslipCommandRequests($commandClass, array $arguments, $requests)
+    {
+        $this->startServer([]);
+
+        $status = $this->runCommand(new $commandClass($this->mockConfig()), $arguments);
+
+        $this->assertSame(Command::SUCCESS, $status);
+        $this->assertSame($requests, $this->resetServer()['requests']);
+    }
+
+    public function timeslipListCommandProvider()
+    {
+        return [
+            // Known N+1: fetches the task (and for day rates, the project) of
+            // every timeslip. Drop the flag once that's fixed.
+            'get-daily-total' => [GetDailyTotal::class, [], true],
+            'get-timeslip-list' => [GetTimeslipList::class, ['taskId' => '1'], false],
+            'get-running-timers' => [GetRunningTimers::class, [], false],
+        ];
+    }
+
+    /**
+     * Doubling the timeslips must not add requests
+     *
+     * @dataProvider timeslipListCommandProvider
+     */
+    public function testTimeslipListRequestsDontGrow($commandClass, array $arguments, $knownNPlusOne)
+    {
+        $requests = [];
+        foreach ([self::EXTRA_TIMESLIPS, 2 * self::EXTRA_TIMESLIPS] as $extraTimeslips) {
+            $this->startServer(['--extra-timeslips' => $extraTimeslips]);
+            $status = $this->runCommand(new $commandClass($this->mockConfig()), $arguments);
+            $this->assertSame(Command::SUCCESS, $status);
+            $requests[] = $this->resetServer()['requests'];
+            $this->stopServer();
+        }
+
+        if ($knownNPlusOne && $requests[0] != $requests[1]) {
+            $this->markTestIncomplete(sprintf(
+                'Known N+1: %d requests grew to %d with twice the timeslips',
+                $requests[0],
+                $requests[1]
+            ));
+        }
+        $this->assertSame($requests[0], $requests[1]);
+    }
+
+    public function testLoginNeedsNoBrowser()
+    {
+        $this->startServer([]);
+        $config = $this->mockConfig();
+        $config->accessToken = null;
+
+        $status = $this->runCommand(new Login($config), $this->loginArguments());
+
+        $this->assertSame(Command::SUCCESS, $status);
+        $this->assertSame('mock-access-token', $config->accessToken['access_token']);
+        // Approval, token and company, all from the one run
+        $this->assertSame(['requests' => 3, 'runs' => 1], $this->summariseReset());
+    }
+
+    public function testFailedApprovalFailsLogin()
+    {
+        $this->startServer(['--error-rate' => 1]);
+        $config = $this->mockConfig();
+        $config->accessToken = null;
+
+        $tester = new CommandTester(new Login($config));
+        $status = $tester->execute($this->loginArguments());
+
+        $this->assertSame(Command::FAILURE, $status);
+        $this->assertStringContainsString('Approval failed: HTTP 503', $tester->getDisplay());
+        $this->assertNull($config->accessToken);
+    }
+
+    public function testOverBudgetFailsCommand()
+    {
+        $this->startServer(['--budget' => 3]);
+
+        $this->expectException(IdentityProviderException::class);
+        $this->expectExceptionMessage('Request budget of 3 exceeded');
+        $this->runCommand(new GetDailyTotal($this->mockConfig()), []);
+    }
+
+    public function testBudgetIsPerCommand()
+    {
+        $this->startServer(['--budget' => 3]);
+
+        // Each run uses the whole budget, so sharing it would fail the second
+        $this->assertSame(Command::SUCCESS, $this->runCommand(new GetTaskList($this->mockConfig()), []));
+        $this->assertSame(Command::SUCCESS, $this->runCommand(new GetTaskList($this->mockConfig()), []));
+        $this->assertSame(2, $this->summariseReset()['runs']);
+    }
+
+    public function testInjectedErrorFailsCommand()
+    {
+        $this->startServer(['--error-rate' => 1]);
+
+        $this->expectException(IdentityProviderException::class);
+        $this->expectExceptionMessage('Injected failure');
+        $this->runCommand(new GetRunningTimers($this->mockConfig()), []);
+    }
+
+    /**
+     * Start mock-server on any free port and wait for it to say where it is
+     */
+    protected function startServer(array $options)
+    {
+        $command = sprintf(
+            'exec %s %s mock-server --port=0',
+            escapeshellarg(PHP_BINARY),
+            escapeshellarg(dirname(__DIR__) . '/freeagent.php')
+        );
+        foreach ($options as $option => $value) {
+            $command .= ' ' . $option . '=' . escapeshellarg($value);
+        }
+
+        // freeagent.php loads and saves its config under $HOME, so keep the
+        // server away from the real one
+        $env = ['HOME' => sys_get_temp_dir()] + getenv();
+
+        $this->log = tempnam(sys_get_temp_dir(), 'mock-api');
+        $this->server = proc_open($command, [
+            0 => ['file', '/dev/null', 'r'],
+            1 => ['file', $this->log, 'a'],
+            2 => ['file', $this->log, 'a'],
+        ], $pipes, null, $env);
+
+        $deadline = microtime(true) + 5;
+        while (!preg_match('#listening on (\S+)#', file_get_contents($this->log), $matches)) {
+            if (microtime(true) > $deadline) {
+                $this->fail("Mock API did not start:\n" . file_get_contents($this->log));
+            }
+            usleep(20000);
+        }
+        $this->baseUrl = $matches[1];
+    }
+
+    protected function stopServer()
+    {
+        if ($this->server) {
+            proc_terminate($this->server);
+            proc_close($this->server);
+            $this->server = null;
+        }
+        if ($this->log) {
+            @unlink($this->log);
+            $this->log = null;
+        }
+    }
+
+    /**
+     * Returns the request counts since the last reset and zeroes them
+     */
+    protected function resetServer()
+    {
+        $response = (new \GuzzleHttp\Client())->post($this->baseUrl . '__mock/reset');
+        return json_decode((string) $response->getBody(), true);
+    }
+
+    /**
+     * Resets the server and returns how many requests it saw from how many runs
+     */
+    protected function summariseReset()
+    {
+        $reset = $this->resetServer();
+        return ['requests' => $reset['requests'], 'runs' => count($reset['runs'])];
+    }
+
+    protected function loginArguments()
+    {
+        return [
+            'clientId' => 'mock',
+            'clientSecret' => 'mock',
+            'timeslipUser' => $this->baseUrl . 'users/1',
+            'environment' => 'mock',
+        ];
+    }
+
+    /**
+     * A config pointing at the running server, holding the token it hands out
+     * so commands can skip logging in
+     */
+    protected function mockConfig()
+    {
+        $config = new Config();
+        $config->environment = 'mock';
+        $config->mockUrl = $this->baseUrl;
+        $config->clientId = 'mock';
+        $config->clientSecret = 'mock';
+        $config->timeslipUser = $this->baseUrl . 'users/1';
+        $config->accessToken = [
+            'access_token' => 'mock-access-token',
+            'refresh_token' => 'mock-refresh-token',
+            'expires' => time() + 3600,
+        ];
+        return $config;
+    }
+
+    protected function runCommand(Command $command, array $arguments)
+    {
+        $tester = new CommandTester($command);
+        return $tester->execute($arguments);
+    }
+}
\ No newline at end of file